@@ -1,19 +1,74 @@
+#include <iostream>
 #include <vector>
 #include <ctime>
 #include <string>
 #include <sstream>
+#include <cstdint>
+#include <climits>
 #include "picosha2.h"
 
 using namespace std;
 
-std::string sha256(const std::string& src) {
+template <typename InputIter>
+std::string sha256(InputIter first, InputIter last) {
     std::vector<unsigned char> hash(picosha2::k_digest_size);
-    picosha2::hash256(src.begin(), src.end(), hash.begin(), hash.end());
+    picosha2::hash256(first, last, hash.begin(), hash.end());
     std::string hex_hash;
     picosha2::bytes_to_hex_string(hash.begin(), hash.end(), hex_hash);
     return hex_hash;
 }
 
+std::string sha256(const std::string& src) {
+    return sha256(src.begin(), src.end());
+}
+
+std::string sha256(const std::vector<unsigned char>& src) {
+    return sha256(src.begin(), src.end());
+}
+
+// Canonical block encoding, used for hashing, storage and transfer:
+//   version(1) | index(4, non-negative) | timestamp | data | previousHash | nonce(4)
+// Integers are big-endian, each string is a 4-byte length followed by its bytes.
+// The nonce is kept last so mining can rewrite it in place.
+const unsigned char BLOCK_ENCODING_VERSION = 1;
+const size_t NONCE_SIZE = 4;
+static_assert(NONCE_SIZE == sizeof(uint32_t), "nonce is written with putUint32");
+
+void putUint32(vector<unsigned char>& out, size_t pos, uint32_t value) {
+    out[pos] = (unsigned char)(value >> 24);
+    out[pos + 1] = (unsigned char)(value >> 16);
+    out[pos + 2] = (unsigned char)(value >> 8);
+    out[pos + 3] = (unsigned char)value;
+}
+
+void appendUint32(vector<unsigned char>& out, uint32_t value) {
+    out.resize(out.size() + 4);
+    putUint32(out, out.size() - 4, value);
+}
+
+void appendField(vector<unsigned char>& out, const string& field) {
+    appendUint32(out, (uint32_t)field.size());
+    out.insert(out.end(), field.begin(), field.end());
+}
+
+bool readUint32(const vector<unsigned char>& in, size_t& pos, uint32_t& value) {
+    if (in.size() - pos < 4)
+        return false;
+    value = ((uint32_t)in[pos] << 24) | ((uint32_t)in[pos + 1] << 16) |
+            ((uint32_t)in[pos + 2] << 8) | (uint32_t)in[pos + 3];
+    pos += 4;
+    return true;
+}
+
+bool readField(const vector<unsigned char>& in, size_t& pos, string& field) {
+    uint32_t length;
+    if (!readUint32(in, pos, length) || in.size() - pos < length)
+        return false;
+    field.assign(in.begin() + pos, in.begin() + pos + length);
+    pos += length;
+    return true;
+}
+
 struct Block {
     int index;
     string timestamp;
@@ -27,16 +82,72 @@ struct Block {
             hash = calculateHash();
         }
 
-    string calculateHash() {
+    // Rebuilds a block from stored fields, keeping the stored hash so it can be verified.
+    Block(int idx, const string& ts, const string& d, const string& prevHash, unsigned int n, const string& storedHash) :
+        index(idx), timestamp(ts), data(d), previousHash(prevHash), hash(storedHash), nonce(n) {}
+
+    // Writes the canonical encoding into 'out', reusing its memory.
+    void serialize(vector<unsigned char>& out) const {
+        out.clear();
+        out.reserve(1 + 4 * 4 + NONCE_SIZE + timestamp.size() + data.size() + previousHash.size());
+        out.push_back(BLOCK_ENCODING_VERSION);
+        appendUint32(out, (uint32_t)index);
+        appendField(out, timestamp);
+        appendField(out, data);
+        appendField(out, previousHash);
+        size_t noncePos = out.size();
+        out.resize(noncePos + NONCE_SIZE);
+        putUint32(out, noncePos, nonce);
+    }
+
+    // Reads a block written by serialize(); 'block' is left unchanged if the bytes are invalid.
+    static bool deserialize(const vector<unsigned char>& bytes, Block& block) {
+        uint32_t idx, n;
+        string ts, d, prevHash;
+        size_t pos = 1;
+        if (bytes.empty() || bytes[0] != BLOCK_ENCODING_VERSION ||
+            !readUint32(bytes, pos, idx) || idx > (uint32_t)INT_MAX ||
+            !readField(bytes, pos, ts) ||
+            !readField(bytes, pos, d) ||
+            !readField(bytes, pos, prevHash) ||
+            !readUint32(bytes, pos, n) || pos != bytes.size()) {
+            return false;
+        }
+        block = Block((int)idx, ts, d, prevHash, n, sha256(bytes));
+        return true;
+    }
+
+    string calculateHash() const {
+        vector<unsigned char> bytes;
+        return calculateHash(bytes);
+    }
+
+    // Same as calculateHash(), but encodes into 'scratch' so callers hashing many blocks reuse one buffer.
+    string calculateHash(vector<unsigned char>& scratch) const {
+        serialize(scratch);
+        return sha256(scratch);
+    }
+
+    // Hash scheme used before the canonical encoding, kept to verify old chains.
+    string calculateLegacyHash() const {
         string input = to_string(index) + timestamp + data + previousHash + to_string(nonce);
         return sha256(input);
     }
 
+    bool hasValidHash(vector<unsigned char>& scratch) const {
+        return hash == calculateHash(scratch);
+    }
+
     void mineBlock(int difficulty) {
         string prefix(difficulty, '0');
+        vector<unsigned char> bytes;
+        serialize(bytes);
+        size_t noncePos = bytes.size() - NONCE_SIZE;
+        hash = sha256(bytes);
         while (hash.substr(0, difficulty) != prefix) {
             nonce++;
-            hash = calculateHash();
+            putUint32(bytes, noncePos, nonce);
+            hash = sha256(bytes);
         }
     }
 };
@@ -51,9 +162,31 @@ public:
         chain.emplace_back(Block(0, getCurrentTimestamp(), "Genesis Block", "0"));
     }
 
+    explicit Blockchain(const vector<Block>& blocks) : chain(blocks), difficulty(0) {}
+
+    // Checks every hash and link. With acceptLegacy, blocks hashed with the old string scheme are
+    // allowed only before the first canonical block; every block after that must be canonical.
+    bool isChainValid(bool acceptLegacy = false) const {
+        vector<unsigned char> scratch;
+        bool legacyAllowed = acceptLegacy;
+        for (size_t i = 0; i < chain.size(); i++) {
+            const Block& block = chain[i];
+            bool legacy = legacyAllowed && block.hash == block.calculateLegacyHash();
+            if (!legacy) {
+                if (!block.hasValidHash(scratch))
+                    return false;
+                legacyAllowed = false;
+            }
+            if (i > 0 && block.previousHash != chain[i - 1].hash)
+                return false;
+        }
+        return true;
+    }
+
     void addBlock(const string& data) {
         const Block& lastBlock = chain.back();
-        Block newBlock(lastBlock.index + 1, getCurrentTimestamp(), data, lastBlock.hash);
+        // no hash yet: mineBlock() encodes the block once and sets it
+        Block newBlock(lastBlock.index + 1, getCurrentTimestamp(), data, lastBlock.hash, 0, "");
         newBlock.mineBlock(difficulty);
         chain.emplace_back(newBlock);
     }
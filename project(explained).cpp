@@ -3,18 +3,72 @@
 #include <ctime>                     // provides functions for working with time and date
 #include <string>                    // provides functionalities for working with strings
 #include <sstream>                   // provides functionalities for working with input/output streams, useful for converting between strings and other data types
+#include <cstdint>                   // provides fixed-width integer types such as uint32_t used in the block encoding
+#include <climits>                   // provides INT_MAX, the largest value an int index can hold
 #include "picosha2.h"                // this header file includes the Picosha2 library, used for computing SHA-256 hash values.
 
 using namespace std;                 // allows to use symbols from the std namespace without needing to prefix them with 'std::'
 
-std::string sha256(const std::string& src) {                                // sha256 is a function with specific parameter constant input src and declares 'src' as a reference to 'std::string'
+template <typename InputIter>
+std::string sha256(InputIter first, InputIter last) {                       // sha256 is a function that hashes any range of bytes given by iterators 'first' and 'last'
     std::vector<unsigned char> hash(picosha2::k_digest_size);               // declares a vector(dynamic array) 'hash' to store elements of type 'unsigned char' i.e bytes of the SHA-256 hash and 'k_digest_size' represents size of hash produced by SHA-256 Algorithm
-    picosha2::hash256(src.begin(), src.end(), hash.begin(), hash.end());    // hash256 is a function designed to compute the SHA-256 hash and arguments specify the range of data to be hashed, src. represents iterator pointing to beginning and end of the input string and hash. represents iterator pointing to the beginning and end of th vector'hash'
+    picosha2::hash256(first, last, hash.begin(), hash.end());               // hash256 is a function designed to compute the SHA-256 hash of the range first..last and writes the result into the vector 'hash'
     std::string hex_hash;                                                   // hex_hash is initialized as empty string 
     picosha2::bytes_to_hex_string(hash.begin(), hash.end(), hex_hash);      // bytes_to_hex_string is a function from picosha2 to convert bytes of hash(stored in vector 'hash') into hexadecimal string , hash. represents as explained above and stores it in 'hex_hash'
     return hex_hash;                                                        // returns the value stored in 'hex_hash'- hexadecimal representation of the SHA-256 hash 
 }
 
+std::string sha256(const std::string& src) {                                // hashes a string, declares 'src' as a reference to 'std::string'
+    return sha256(src.begin(), src.end());                                  // src. represents iterator pointing to beginning and end of the input string
+}
+
+std::string sha256(const std::vector<unsigned char>& src) {                 // hashes a buffer of bytes, used for the encoded block
+    return sha256(src.begin(), src.end());
+}
+
+// Canonical block encoding, used for hashing, storage and transfer:
+//   version(1) | index(4, non-negative) | timestamp | data | previousHash | nonce(4)
+// Integers are big-endian, each string is a 4-byte length followed by its bytes.
+// The nonce is kept last so mining can rewrite it in place.
+const unsigned char BLOCK_ENCODING_VERSION = 1;                             // version byte written at the start of every encoded block
+const size_t NONCE_SIZE = 4;                                                // number of bytes used by the nonce at the end of the encoding
+static_assert(NONCE_SIZE == sizeof(uint32_t), "nonce is written with putUint32");   // the nonce bytes must match what putUint32 writes, mining rewrites them in place
+
+void putUint32(vector<unsigned char>& out, size_t pos, uint32_t value) {    // writes 'value' as 4 big-endian bytes starting at position 'pos'
+    out[pos] = (unsigned char)(value >> 24);
+    out[pos + 1] = (unsigned char)(value >> 16);
+    out[pos + 2] = (unsigned char)(value >> 8);
+    out[pos + 3] = (unsigned char)value;
+}
+
+void appendUint32(vector<unsigned char>& out, uint32_t value) {             // adds 4 bytes to the end of 'out' and writes 'value' into them
+    out.resize(out.size() + 4);
+    putUint32(out, out.size() - 4, value);
+}
+
+void appendField(vector<unsigned char>& out, const string& field) {         // writes the length of the string first and then its bytes, so fields can never run into each other
+    appendUint32(out, (uint32_t)field.size());
+    out.insert(out.end(), field.begin(), field.end());
+}
+
+bool readUint32(const vector<unsigned char>& in, size_t& pos, uint32_t& value) {    // reads 4 big-endian bytes at 'pos', returns false if the buffer is too short
+    if (in.size() - pos < 4)
+        return false;
+    value = ((uint32_t)in[pos] << 24) | ((uint32_t)in[pos + 1] << 16) |
+            ((uint32_t)in[pos + 2] << 8) | (uint32_t)in[pos + 3];
+    pos += 4;
+    return true;
+}
+
+bool readField(const vector<unsigned char>& in, size_t& pos, string& field) {       // reads a length-prefixed string at 'pos', returns false if the buffer is too short
+    uint32_t length;
+    if (!readUint32(in, pos, length) || in.size() - pos < length)
+        return false;
+    field.assign(in.begin() + pos, in.begin() + pos + length);
+    pos += length;
+    return true;
+}
+
 struct Block {                        // declaring a struct named 'Block'  user-defined data type that allows to group together related data fields under a single name
 // below are the member variables within the Block structure
     int index;                        // index(integer) of the block
@@ -29,16 +83,72 @@ struct Block {                        // declaring a struct named 'Block'  user-
             hash = calculateHash();                                                     // contains the initialization of the hash variable using the calculateHash() function. 
         }
 
-    string calculateHash() {                                                                    // declaring a function named calculateHash() to calculate hash which returns a string.
+    // Rebuilds a block from stored fields, keeping the stored hash so it can be verified.
+    Block(int idx, const string& ts, const string& d, const string& prevHash, unsigned int n, const string& storedHash) :     // constructor used when loading a block that was saved earlier, including old chains
+        index(idx), timestamp(ts), data(d), previousHash(prevHash), hash(storedHash), nonce(n) {}                           // the hash is not recalculated, so isChainValid() can check it against the fields
+
+    // Writes the canonical encoding into 'out', reusing its memory.
+    void serialize(vector<unsigned char>& out) const {
+        out.clear();                                                                                // emptying the buffer but keeping its memory
+        out.reserve(1 + 4 * 4 + NONCE_SIZE + timestamp.size() + data.size() + previousHash.size());   // reserving the exact size so the buffer is allocated at most once
+        out.push_back(BLOCK_ENCODING_VERSION);
+        appendUint32(out, (uint32_t)index);
+        appendField(out, timestamp);
+        appendField(out, data);
+        appendField(out, previousHash);
+        size_t noncePos = out.size();                                                               // nonce is written last so mining only has to change these NONCE_SIZE bytes
+        out.resize(noncePos + NONCE_SIZE);
+        putUint32(out, noncePos, nonce);
+    }
+
+    // Reads a block written by serialize(); 'block' is left unchanged if the bytes are invalid.
+    static bool deserialize(const vector<unsigned char>& bytes, Block& block) {                     // rebuilding a block from its encoded bytes, e.g. when reading it back from storage
+        uint32_t idx, n;
+        string ts, d, prevHash;
+        size_t pos = 1;                                                                             // skipping the version byte
+        if (bytes.empty() || bytes[0] != BLOCK_ENCODING_VERSION ||
+            !readUint32(bytes, pos, idx) || idx > (uint32_t)INT_MAX ||                              // the index must fit in an int, negative indexes are never valid blocks
+            !readField(bytes, pos, ts) ||
+            !readField(bytes, pos, d) ||
+            !readField(bytes, pos, prevHash) ||
+            !readUint32(bytes, pos, n) || pos != bytes.size()) {                                    // every field must be present and nothing may be left over
+            return false;
+        }
+        block = Block((int)idx, ts, d, prevHash, n, sha256(bytes));                                 // the bytes are already the canonical encoding, so they are hashed directly
+        return true;
+    }
+
+    string calculateHash() const {                                                              // declaring a function named calculateHash() to calculate hash which returns a string.
+        vector<unsigned char> bytes;                                                            // buffer for the encoding of the block's current fields
+        return calculateHash(bytes);                                                            // hashing with the overload below
+    }
+
+    // Same as calculateHash(), but encodes into 'scratch' so callers hashing many blocks reuse one buffer.
+    string calculateHash(vector<unsigned char>& scratch) const {
+        serialize(scratch);                                                                     // encoding the block's index, timestamp, data, previous hash, and nonce into 'scratch'
+        return sha256(scratch);                                                                 // computes SHA-256 hash of 'scratch' using 'sha256' function defined previously
+    }
+
+    // Hash scheme used before the canonical encoding, kept to verify old chains.
+    string calculateLegacyHash() const {
         string input = to_string(index) + timestamp + data + previousHash + to_string(nonce);   // concatenating the block's index, timestamp, data, previous hash, and nonce into a single string named 'input'
-        return sha256(input);                                                                   // computes SHA-256 hash of 'input' using 'sha256' function defined previously
+        return sha256(input);                                                                   // computes SHA-256 hash of 'input' the way blocks were hashed before the canonical encoding
+    }
+
+    bool hasValidHash(vector<unsigned char>& scratch) const {                                   // checks that the stored hash matches the block's current contents
+        return hash == calculateHash(scratch);                                                  // the hash is recalculated from the fields, so any changed field is detected
     }
 
     void mineBlock(int difficulty) {                        // declaring a void function 'mineblock' taking integer parameter and modifing the 'nonce' and 'hash' of Block                
         string prefix(difficulty, '0');                     // prefix(string) represents the target hash pattern that the block's hash must meet to be considered valid
+        vector<unsigned char> bytes;                        // buffer reused for every attempt
+        serialize(bytes);                                   // encoding the block once before the loop
+        size_t noncePos = bytes.size() - NONCE_SIZE;        // position of the nonce bytes at the end of the encoding
+        hash = sha256(bytes);                               // starting from the hash of the block's current fields
         while (hash.substr(0, difficulty) != prefix) {      // using while loop for recalculating the hash until a hash meeting the required difficulty is found 
             nonce++;                                        // incrementing nonce within loop
-            hash = calculateHash();                         // newly calculated hash is stored in the hash variable.
+            putUint32(bytes, noncePos, nonce);              // updating only the nonce bytes instead of encoding the whole block again
+            hash = sha256(bytes);                           // newly calculated hash is stored in the hash variable.
         }
     }
 };
@@ -53,9 +163,30 @@ public:
         chain.emplace_back(Block(0, getCurrentTimestamp(), "Genesis Block", "0"));      // creating a genesis block with index and previous hash 0 and timestamp when it is created 
     }
 
+    explicit Blockchain(const vector<Block>& blocks) : chain(blocks), difficulty(0) {}   // constructor to create a blockchain from blocks that already exist, e.g. an old chain
+
+    // Checks every hash and link. With acceptLegacy, blocks hashed with the old string scheme are
+    // allowed only before the first canonical block; every block after that must be canonical.
+    bool isChainValid(bool acceptLegacy = false) const {
+        vector<unsigned char> scratch;                                              // one buffer reused to encode every block
+        bool legacyAllowed = acceptLegacy;                                          // stays true only while the chain is still in its legacy prefix
+        for (size_t i = 0; i < chain.size(); i++) {
+            const Block& block = chain[i];
+            bool legacy = legacyAllowed && block.hash == block.calculateLegacyHash();   // old blocks are accepted only before the first canonical block
+            if (!legacy) {
+                if (!block.hasValidHash(scratch))                                   // the block's contents must match its hash
+                    return false;
+                legacyAllowed = false;                                              // from here on only canonical blocks are accepted
+            }
+            if (i > 0 && block.previousHash != chain[i - 1].hash)                   // the block must point to the hash of the block before it
+                return false;
+        }
+        return true;
+    }
+
     void addBlock(const string& data) {                                                     // declaring a function addblock which will siply add a new block by taking parameters as the data of new block directly
         const Block& lastBlock = chain.back();                                              // retrieving a reference to the last block in 'chain'
-        Block newBlock(lastBlock.index + 1, getCurrentTimestamp(), data, lastBlock.hash);   // create a new block instance and assigning the index(incremented from last block), setting timestamp, data and also storing hash of previous block 
+        Block newBlock(lastBlock.index + 1, getCurrentTimestamp(), data, lastBlock.hash, 0, "");   // create a new block instance and assigning the index(incremented from last block), setting timestamp, data and also storing hash of previous block, its own hash is left empty because mineBlock() sets it
         newBlock.mineBlock(difficulty);                                                     // 'Block' object newBlock has a method named 'mineBlock()' that is being called with a parameter 'difficulty'
         chain.emplace_back(newBlock);                                                       //  adding new block to the end of 'chain' which is a vector 
     }